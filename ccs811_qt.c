@@ -4,20 +4,113 @@
 #include <sys/ioctl.h>
 #include <linux/i2c-dev.h>
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
 
-#define CCS811_I2C_DEV  "/dev/i2c-2"   
-#define CCS811_ADDR     0x5B           
+#define CCS811_I2C_DEV  "/dev/i2c-2"
+#define CCS811_ADDR     0x5B
+
+// Registers
+#define CCS811_REG_MEAS_MODE       0x01
+#define CCS811_REG_ALG_RESULT_DATA 0x02
+#define CCS811_REG_ENV_DATA        0x05
+#define CCS811_REG_BASELINE        0x11
+#define CCS811_REG_APP_START       0xF4
+
+// Saved baseline (written atomically via <file>.tmp + rename)
+#ifndef CCS811_BASELINE_FILE
+#define CCS811_BASELINE_FILE    "/root/ccs811_baseline.txt"
+#endif
+#define CCS811_BASELINE_MAX_AGE (14L * 24 * 3600)   // older than 2 weeks: ignore
+#define CCS811_BASELINE_MAX_SKEW (24L * 3600)       // dated further ahead: bad stamp
+
+// The board has no RTC; until NTP sets it the clock starts near the epoch.
+// Any wall time before this (2021-01-01) means "clock not set".
+#define CCS811_CLOCK_VALID_AFTER 1609459200L
+
+// When the age cannot be known (either stamp taken with the clock unset),
+// a baseline is restored at most this many times without being re-saved.
+#define CCS811_BASELINE_MAX_RESTORES 14
+
+// Readings are not trustworthy until the sensor has run for 20 min (run-in).
+// Without a restored baseline the algorithm has to learn one from scratch,
+// which takes about a day of continuous operation. A baseline is only saved
+// once conditioning is over, so a restored one is always a learned one.
+#define CCS811_RUN_IN_SEC       (20L * 60)
+#define CCS811_LEARN_SEC        (24L * 3600)
 
-static int fd = -1;
 static int inited = 0;
+static int baseline_restored = 0;
+static long start_sec = 0;
 
-// initialize CCS811（APP_START + MEAS_MODE）
-int init_ccs811(void)
+#ifdef CCS811_EMULATE
+// -------- Emulated register file (desktop builds / testing) --------
+// Register contents live in ccs811_emu_regs[]; writes to BASELINE are
+// visible to later reads, ALG_RESULT_DATA reports ccs811_emu_eco2.
+// ccs811_emu_clock >= 0 replaces the monotonic clock (seconds),
+// ccs811_emu_wall >= 0 the wall clock (time(NULL)).
+uint8_t ccs811_emu_regs[256][8];
+int ccs811_emu_eco2 = 400;
+long ccs811_emu_clock = -1;
+long ccs811_emu_wall = -1;
+
+// Back to power-on state, so a test can run init_ccs811() again
+void ccs811_emu_reset(void)
 {
-    if (inited) {
-        return 0;
+    memset(ccs811_emu_regs, 0, sizeof(ccs811_emu_regs));
+    inited = 0;
+    baseline_restored = 0;
+}
+#endif
+
+static long monotonic_sec(void)
+{
+#ifdef CCS811_EMULATE
+    if (ccs811_emu_clock >= 0)
+        return ccs811_emu_clock;
+#endif
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long)ts.tv_sec;
+}
+
+static long wall_sec(void)
+{
+#ifdef CCS811_EMULATE
+    if (ccs811_emu_wall >= 0)
+        return ccs811_emu_wall;
+#endif
+    return (long)time(NULL);
+}
+
+#ifdef CCS811_EMULATE
+
+static int i2c_open(void)
+{
+    return 0;
+}
+
+static int reg_write(uint8_t reg, const uint8_t *buf, int len)
+{
+    if (len > 0)
+        memcpy(ccs811_emu_regs[reg], buf, len);
+    return 0;
+}
+
+static int reg_read(uint8_t reg, uint8_t *buf, int len)
+{
+    if (reg == CCS811_REG_ALG_RESULT_DATA) {
+        ccs811_emu_regs[reg][0] = (uint8_t)(ccs811_emu_eco2 >> 8);
+        ccs811_emu_regs[reg][1] = (uint8_t)(ccs811_emu_eco2 & 0xFF);
     }
+    memcpy(buf, ccs811_emu_regs[reg], len);
+    return 0;
+}
+#else
+static int fd = -1;
 
+static int i2c_open(void)
+{
     fd = open(CCS811_I2C_DEV, O_RDWR);
     if (fd < 0) {
         perror("Failed to open I2C bus");
@@ -28,22 +121,143 @@ int init_ccs811(void)
         perror("Failed to set I2C address");
         return -2;
     }
+    return 0;
+}
+
+// write register address followed by len data bytes (len may be 0)
+static int reg_write(uint8_t reg, const uint8_t *buf, int len)
+{
+    uint8_t tx[9];
+    if (len > 8)
+        return -1;
+
+    tx[0] = reg;
+    if (len > 0)
+        memcpy(tx + 1, buf, len);
+    if (write(fd, tx, len + 1) != len + 1)
+        return -1;
+    return 0;
+}
+
+static int reg_read(uint8_t reg, uint8_t *buf, int len)
+{
+    // select register
+    if (write(fd, &reg, 1) != 1)
+        return -1;
+    if (read(fd, buf, len) != len)
+        return -1;
+    return 0;
+}
+#endif
+
+// -------- Baseline persistence --------
+
+static int baseline_valid(unsigned baseline)
+{
+    // 0x0000 / 0xFFFF are what a blank or failed read looks like
+    return baseline != 0x0000 && baseline != 0xFFFF;
+}
+
+// File format: "<baseline hex> <saved at, wall sec> <restores since save>"
+// (older files without the restore count read as 0 restores).
+
+// Load the saved baseline; returns 0 and fills the outputs if it is valid
+// and not known to be stale.
+static int load_baseline(uint16_t *baseline, long *saved_at, int *restores)
+{
+    FILE *f = fopen(CCS811_BASELINE_FILE, "r");
+    if (!f)
+        return -1;
+
+    unsigned value = 0;
+    long stamp = 0;
+    int count = 0;
+    int n = fscanf(f, "%x %ld %d", &value, &stamp, &count);
+    fclose(f);
+    if (n < 2 || value > 0xFFFF || !baseline_valid(value))
+        return -2;
+
+    long now = wall_sec();
+    if (now >= CCS811_CLOCK_VALID_AFTER && stamp >= CCS811_CLOCK_VALID_AFTER) {
+        // Both stamps from a set clock: the age is real
+        long age = now - stamp;
+        if (age > CCS811_BASELINE_MAX_AGE || age < -CCS811_BASELINE_MAX_SKEW)
+            return -3;
+    } else if (count >= CCS811_BASELINE_MAX_RESTORES) {
+        // Age unknown: only trust it for a bounded number of boots
+        return -4;
+    }
+
+    *baseline = (uint16_t)value;
+    *saved_at = stamp;
+    *restores = count;
+    return 0;
+}
+
+static int store_baseline(uint16_t baseline, long saved_at, int restores)
+{
+    const char *tmp = CCS811_BASELINE_FILE ".tmp";
+    FILE *f = fopen(tmp, "w");
+    if (!f) {
+        perror("Failed to write baseline");
+        return -1;
+    }
+
+    int ok = fprintf(f, "%04x %ld %d\n", baseline, saved_at, restores) > 0;
+    ok = (fflush(f) == 0) && ok;
+    ok = (fsync(fileno(f)) == 0) && ok;
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename(tmp, CCS811_BASELINE_FILE) != 0) {
+        perror("Failed to write baseline");
+        unlink(tmp);
+        return -2;
+    }
+    return 0;
+}
+
+// initialize CCS811（APP_START + BASELINE restore + MEAS_MODE）
+int init_ccs811(void)
+{
+    if (inited) {
+        return 0;
+    }
+
+    int rc = i2c_open();
+    if (rc != 0) {
+        return rc;
+    }
 
     // -------- APP_START --------
-    uint8_t app_start = 0xF4;
-    if (write(fd, &app_start, 1) != 1) {
+    if (reg_write(CCS811_REG_APP_START, NULL, 0) != 0) {
         perror("Failed to send APP_START");
         return -3;
     }
     usleep(10000);  // 10 ms
 
+    // -------- BASELINE restore (skip the baseline re-learning) --------
+    uint16_t baseline;
+    long saved_at;
+    int restores;
+    baseline_restored = 0;
+    if (load_baseline(&baseline, &saved_at, &restores) == 0) {
+        uint8_t b[2] = {(uint8_t)(baseline >> 8), (uint8_t)(baseline & 0xFF)};
+        if (reg_write(CCS811_REG_BASELINE, b, 2) == 0) {
+            baseline_restored = 1;
+            // Count the restore, so a file of unknown age cannot live forever
+            store_baseline(baseline, saved_at, restores + 1);
+        } else {
+            perror("Failed to restore BASELINE");
+        }
+    }
+
     // -------- MEAS_MODE = 1s --------
-    uint8_t meas_mode[2] = {0x01, 0x10};
-    if (write(fd, meas_mode, 2) != 2) {
+    uint8_t meas_mode = 0x10;
+    if (reg_write(CCS811_REG_MEAS_MODE, &meas_mode, 1) != 0) {
         perror("Failed to write MEAS_MODE");
         return -4;
     }
 
+    start_sec = monotonic_sec();
     inited = 1;
     return 0;
 }
@@ -55,20 +269,13 @@ int read_co2_ppm(void)
         if (init_ccs811() != 0) {
             return -1;
         }
-        sleep(1);  
+        sleep(1);
     }
 
-    uint8_t reg = 0x02;   // ALG_RESULT_DATA
     uint8_t data[4];
 
-    // select register
-    if (write(fd, &reg, 1) != 1) {
-        perror("write reg");
-        return -2;
-    }
-
-    // read 4 bytes
-    if (read(fd, data, 4) != 4) {
+    // read 4 bytes of ALG_RESULT_DATA
+    if (reg_read(CCS811_REG_ALG_RESULT_DATA, data, 4) != 0) {
         perror("read data");
         return -3;
     }
@@ -76,3 +283,59 @@ int read_co2_ppm(void)
     int eCO2 = (data[0] << 8) | data[1];
     return eCO2;
 }
+
+// Seconds left before readings are trustworthy (0 once conditioned).
+int ccs811_conditioning_remaining(void)
+{
+    if (!inited)
+        return -1;
+
+    long needed  = baseline_restored ? CCS811_RUN_IN_SEC : CCS811_LEARN_SEC;
+    long elapsed = monotonic_sec() - start_sec;
+    return elapsed >= needed ? 0 : (int)(needed - elapsed);
+}
+
+// Read the current BASELINE register and persist it. Skipped (returns 1)
+// until conditioning is over: during the run-in, and for a full learning
+// period when no baseline was restored, the register is not a learned value.
+int ccs811_save_baseline(void)
+{
+    if (!inited)
+        return -1;
+    if (ccs811_conditioning_remaining() != 0)
+        return 1;
+
+    uint8_t b[2];
+    if (reg_read(CCS811_REG_BASELINE, b, 2) != 0) {
+        perror("read BASELINE");
+        return -2;
+    }
+
+    uint16_t baseline = (uint16_t)((b[0] << 8) | b[1]);
+    if (!baseline_valid(baseline))
+        return -3;
+    return store_baseline(baseline, wall_sec(), 0);
+}
+
+// ENV_DATA compensation: relative humidity (%) and temperature (°C), both
+// sent as unsigned 1/512 fixed point, temperature offset by +25 °C.
+int ccs811_set_env_data(double humidity_pct, double temp_c)
+{
+    if (!inited)
+        return -1;
+    if (humidity_pct < 0.0 || humidity_pct > 100.0 ||
+        temp_c < -25.0 || temp_c > 100.0)
+        return -2;
+
+    unsigned hum = (unsigned)(humidity_pct * 512.0 + 0.5);
+    unsigned tmp = (unsigned)((temp_c + 25.0) * 512.0 + 0.5);
+    uint8_t env[4] = {
+        (uint8_t)(hum >> 8), (uint8_t)(hum & 0xFF),
+        (uint8_t)(tmp >> 8), (uint8_t)(tmp & 0xFF)
+    };
+    if (reg_write(CCS811_REG_ENV_DATA, env, 4) != 0) {
+        perror("write ENV_DATA");
+        return -3;
+    }
+    return 0;
+}
@@ -0,0 +1,185 @@
+#ifndef CHANGE_DETECTOR_H
+#define CHANGE_DETECTOR_H
+
+#include <algorithm>
+#include <cmath>
+
+// -------- Streaming change / anomaly detector (O(1) time and memory per sample) --------
+// EWMA tracks the running level and spread; a two-sided CUSUM on the
+// standardized residual flags level shifts (door closed, ventilation off).
+// Spikes are single outliers that return to the level on the next sample;
+// stuck-at is a long run of identical raw values.
+class ChangeDetector {
+public:
+    enum Event { None = 0, StepUp, StepDown, Spike, Stuck };
+
+    ChangeDetector()
+        : alpha(0.1),
+          minSigma(15.0),
+          cusumK(0.5),
+          cusumH(8.0),
+          spikeSigmas(6.0),
+          stuckRun(60),
+          stuckIgnore(400),   // CCS811 clamps eCO2 at 400 ppm in clean air
+          warmup(10),
+          stepHoldOff(120)
+    {
+        reset();
+    }
+
+    void reset() {
+        count = 0;
+        mean = 0.0;
+        var = 0.0;
+        gPos = gNeg = 0.0;
+        posStart = negStart = 0;
+        lastStep = None;
+        holdUntil = 0;
+        lastValue = -1;
+        sameRun = 0;
+        pendingSpike = false;
+        pendingValue = 0;
+        onsetAgo = 0;
+    }
+
+    // Feed one sample; returns the event detected at this sample (if any).
+    // onset() then gives how many samples ago the event started.
+    Event addSample(int v) {
+        ++count;
+        onsetAgo = 0;
+
+        // ----- Stuck-at: run of identical values -----
+        if (v == lastValue) {
+            ++sameRun;
+        } else {
+            sameRun = 1;
+            lastValue = v;
+        }
+        if (sameRun == stuckRun && v != stuckIgnore) {
+            onsetAgo = stuckRun - 1;
+            return Stuck;
+        }
+
+        if (count <= warmup) {
+            updateStats(v);
+            return None;
+        }
+
+        double sigma = std::max(minSigma, std::sqrt(var));
+        double z = (v - mean) / sigma;
+
+        // ----- Spike: previous sample was an outlier, this one is back -----
+        if (pendingSpike) {
+            pendingSpike = false;
+            if (std::fabs(z) < spikeSigmas / 2) {
+                updateStats(v);
+                onsetAgo = 1;
+                return Spike;
+            }
+            // Outlier persisted: it is a level shift, replay it through CUSUM
+            Event e = cusum(pendingValue, count - 1);
+            if (e != None) {
+                onsetAgo = std::max(1, onsetAgo);
+                return e;
+            }
+        } else if (std::fabs(z) > spikeSigmas) {
+            // Hold the outlier out of the statistics until we know more
+            pendingSpike = true;
+            pendingValue = v;
+            return None;
+        }
+
+        return cusum(v, count);
+    }
+
+    int onset() const { return onsetAgo; }
+
+    static const char *eventName(Event e) {
+        switch (e) {
+        case StepUp:   return "step_up";
+        case StepDown: return "step_down";
+        case Spike:    return "spike";
+        case Stuck:    return "stuck";
+        default:       return "none";
+        }
+    }
+
+private:
+    // Two-sided CUSUM on the standardized residual of sample #idx
+    Event cusum(int v, long idx) {
+        double z = (v - mean) / std::max(minSigma, std::sqrt(var));
+        if (gPos == 0.0) posStart = idx;
+        if (gNeg == 0.0) negStart = idx;
+        gPos = std::max(0.0, gPos + z - cusumK);
+        gNeg = std::max(0.0, gNeg - z - cusumK);
+
+        Event e = None;
+        if (gPos > cusumH) {
+            e = StepUp;
+            onsetAgo = int(count - posStart);
+        } else if (gNeg > cusumH) {
+            e = StepDown;
+            onsetAgo = int(count - negStart);
+        }
+
+        if (e == None) {
+            updateStats(v);
+            return None;
+        }
+
+        // Re-anchor on the new level. The spread estimate is kept: the
+        // alarm sample never entered it, so it is still the noise level.
+        mean = v;
+        gPos = gNeg = 0.0;
+
+        // A slow rise (door closed, τ of minutes) trips the CUSUM again and
+        // again as the level keeps moving. Same-direction alarms within the
+        // hold-off belong to the step already reported: merge them and keep
+        // holding until the level has been quiet for a full hold-off.
+        bool merged = e == lastStep && count < holdUntil;
+        lastStep = e;
+        holdUntil = count + stepHoldOff;
+        if (merged) {
+            onsetAgo = 0;
+            return None;
+        }
+        return e;
+    }
+
+    void updateStats(int v) {
+        if (count == 1) {
+            mean = v;
+            var = 0.0;
+            return;
+        }
+        double d = v - mean;
+        mean += alpha * d;
+        var = (1.0 - alpha) * (var + alpha * d * d);
+    }
+
+    // Tuning
+    const double alpha;
+    const double minSigma;
+    const double cusumK;
+    const double cusumH;
+    const double spikeSigmas;
+    const int stuckRun;
+    const int stuckIgnore;
+    const int warmup;
+    const int stepHoldOff;    // samples: same-direction steps merge within this
+
+    // State
+    long count;
+    double mean, var;
+    double gPos, gNeg;
+    long posStart, negStart;
+    Event lastStep;
+    long holdUntil;
+    int lastValue;
+    int sameRun;
+    bool pendingSpike;
+    int pendingValue;
+    int onsetAgo;
+};
+
+#endif // CHANGE_DETECTOR_H
@@ -0,0 +1,166 @@
+#ifndef CO2_REPLAY_H
+#define CO2_REPLAY_H
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "change_detector.h"
+
+// -------- Offline replay: ./my_qt_app --replay /root/co2_log.csv --------
+// Runs the change detector over a recorded log and reports every event,
+// plus the per-sample cost of the detector. Also built on the host by
+// make -C tests check, against tests/co2_replay_fixture.csv.
+//
+// A log may carry a third column naming the event expected to start at that
+// sample (step_up, step_down, spike, stuck) and an optional fourth column
+// with the detection latency allowed for it, in samples. If any are present
+// the replay is a check: it exits non-zero when an expected event is missed
+// or late, or an unexpected one is reported. Lines without a number in the
+// second column (the header) and "# ..." comment lines are skipped.
+struct ReplaySample {
+    char ts[24];
+    int ppm;
+    ChangeDetector::Event expected;
+    int maxLatency;
+};
+
+inline ChangeDetector::Event replayEventFromName(const char *name)
+{
+    const ChangeDetector::Event all[] = {
+        ChangeDetector::StepUp, ChangeDetector::StepDown,
+        ChangeDetector::Spike, ChangeDetector::Stuck
+    };
+    for (ChangeDetector::Event e : all) {
+        if (strncmp(name, ChangeDetector::eventName(e), strlen(ChangeDetector::eventName(e))) == 0)
+            return e;
+    }
+    return ChangeDetector::None;
+}
+
+// Default detection latency limits (samples after the annotated start)
+inline int replayDefaultLatency(ChangeDetector::Event e)
+{
+    switch (e) {
+    case ChangeDetector::Spike: return 1;    // confirmed by the next sample
+    case ChangeDetector::Stuck: return 60;   // needs the full stuck run
+    default:                    return 5;
+    }
+}
+
+inline int replayLog(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return 1;
+    }
+
+    std::vector<ReplaySample> log;
+    bool annotated = false;
+    int maxLimit = 0;
+    char line[128];
+
+    while (fgets(line, sizeof(line), f)) {
+        // "yyyy-MM-dd hh:mm:ss,ppm[,expected[,max latency]]"
+        if (line[0] == '#')
+            continue;
+        char *comma = strchr(line, ',');
+        if (!comma)
+            continue;
+        char *end;
+        long v = strtol(comma + 1, &end, 10);
+        if (end == comma + 1)
+            continue;
+        *comma = '\0';
+
+        ReplaySample s;
+        snprintf(s.ts, sizeof(s.ts), "%.23s", line);
+        s.ppm = int(v);
+        s.expected = ChangeDetector::None;
+        s.maxLatency = 0;
+        if (*end == ',') {
+            s.expected = replayEventFromName(end + 1);
+            const char *limit = strchr(end + 1, ',');
+            s.maxLatency = limit ? atoi(limit + 1) : 0;
+            if (s.maxLatency <= 0)
+                s.maxLatency = replayDefaultLatency(s.expected);
+        }
+        if (s.expected != ChangeDetector::None) {
+            annotated = true;
+            maxLimit = std::max(maxLimit, s.maxLatency);
+        }
+        log.push_back(s);
+    }
+    fclose(f);
+
+    // ----- Cost: time the whole loop, not each call -----
+    ChangeDetector timed;
+    long timedEvents = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (const ReplaySample &s : log)
+        timedEvents += timed.addSample(s.ppm) != ChangeDetector::None;
+    auto t1 = std::chrono::steady_clock::now();
+    double totalNs = std::chrono::duration<double, std::nano>(t1 - t0).count();
+
+    // ----- Events, matched against the annotations -----
+    ChangeDetector detector;
+    std::vector<bool> matched(log.size(), false);
+    long events = 0, hits = 0, latencySum = 0;
+    int failures = 0;
+
+    for (size_t i = 0; i < log.size(); ++i) {
+        ChangeDetector::Event e = detector.addSample(log[i].ppm);
+        if (e == ChangeDetector::None)
+            continue;
+        ++events;
+
+        // Oldest unmatched annotation of the same type still within its limit
+        long hit = -1;
+        for (long a = std::max(0L, long(i) - maxLimit); a <= long(i); ++a) {
+            if (log[a].expected == e && !matched[a] && long(i) - a <= log[a].maxLatency) {
+                hit = a;
+                break;
+            }
+        }
+
+        printf("%s  %-9s  %5d ppm  ", log[i].ts, ChangeDetector::eventName(e), log[i].ppm);
+        if (hit >= 0) {
+            // Measured against the annotation, not the detector's own estimate
+            matched[hit] = true;
+            ++hits;
+            latencySum += long(i) - hit;
+            printf("latency %ld samples\n", long(i) - hit);
+        } else if (annotated) {
+            printf("UNEXPECTED\n");
+            ++failures;
+        } else {
+            printf("estimated onset %d samples earlier\n", detector.onset());
+        }
+    }
+
+    for (size_t a = 0; a < log.size(); ++a) {
+        if (log[a].expected != ChangeDetector::None && !matched[a]) {
+            printf("%s  %-9s  MISSED (limit %d samples)\n", log[a].ts,
+                   ChangeDetector::eventName(log[a].expected), log[a].maxLatency);
+            ++failures;
+        }
+    }
+
+    printf("\n%ld samples, %ld events", long(log.size()), events);
+    if (annotated)
+        printf(", %ld expected, mean detection latency %.1f samples",
+               hits, hits ? double(latencySum) / hits : 0.0);
+    printf("\ndetector cost: %.0f ns/sample\n", log.empty() ? 0.0 : totalNs / log.size());
+    if (timedEvents != events) {
+        printf("timing pass saw %ld events, detection pass %ld\n", timedEvents, events);
+        ++failures;
+    }
+    if (annotated)
+        printf("%s: %d failure(s)\n", failures ? "FAIL" : "PASS", failures);
+    return failures ? 1 : 0;
+}
+
+#endif // CO2_REPLAY_H
@@ -7,7 +7,6 @@
 #include <QStackedWidget>
 #include <QTimer>
 #include <QPainter>
-#include <QDateTime>
 #include <QVector>
 #include <QPolygon>
 #include <QMouseEvent>
@@ -15,19 +14,122 @@
 #include <QFontMetrics>
 #include <QScreen>
 #include <QLinearGradient>
+#include <QPixmap>
+#include <QImage>
+#ifdef CO2_WAKE_REPLAY
+#include <QWindow>
+#include <qpa/qwindowsysteminterface.h>
+#endif
 #include <algorithm>
 #include <numeric>
 #include <cstdlib> 
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <vector>
 #include <QFile>
-#include <QTextStream> 
+#include <QDir>
 #include <QString>
+#include <QElapsedTimer>
+#include <QDebug>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "change_detector.h"
+#include "co2_replay.h"
+
 extern "C" int init_ccs811(void);
 extern "C" int read_co2_ppm(void);
+extern "C" int ccs811_conditioning_remaining(void);
+extern "C" int ccs811_save_baseline(void);
+
+#ifdef CO2_COUNT_ALLOCS
+// -------- Allocation accounting (qmake CONFIG+=alloc_count) --------
+// Replaces global operator new, and malloc() as well, because Qt's
+// containers (QString, QVector, ...) allocate with malloc directly.
+// Counted per thread, so only the GUI thread's own work is measured.
+#include <new>
+
+static __thread long threadAllocs = 0;
+static int allocCheckTicks = 0;     // --alloc-check N: exit after N ticks
+
+extern "C" {
+void *__libc_malloc(size_t n);
+void *__libc_calloc(size_t n, size_t m);
+void *__libc_realloc(void *p, size_t n);
+void __libc_free(void *p);
+
+void *malloc(size_t n) noexcept { ++threadAllocs; return __libc_malloc(n); }
+void *calloc(size_t n, size_t m) noexcept { ++threadAllocs; return __libc_calloc(n, m); }
+void *realloc(void *p, size_t n) noexcept { ++threadAllocs; return __libc_realloc(p, n); }
+void free(void *p) noexcept { __libc_free(p); }
+}
+
+void *operator new(std::size_t n)
+{
+    ++threadAllocs;
+    void *p = __libc_malloc(n ? n : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+void *operator new[](std::size_t n) { return operator new(n); }
+void operator delete(void *p) noexcept { __libc_free(p); }
+void operator delete[](void *p) noexcept { __libc_free(p); }
+
+static long threadAllocCount() { return threadAllocs; }
+
+// --alloc-check drives the emulated sensor (alloc_count implies
+// CCS811_EMULATE) through a scripted 200-tick cycle, so every branch of the
+// data path runs: quality changes, a step up and back down, a spike above
+// the red-LED threshold and a stuck run.
+extern "C" int ccs811_emu_eco2;
+extern "C" long ccs811_emu_clock;
+
+static void allocCheckDriveSensor(int tick)
+{
+    if (tick == 3)
+        ccs811_emu_clock += 2L * 24 * 3600;   // conditioning over
+
+    int n = tick % 200;
+    int wobble = (tick % 7) * 3;              // new label text every tick
+    if (n < 40)       ccs811_emu_eco2 = 600 + wobble;    // good
+    else if (n < 80)  ccs811_emu_eco2 = 900 + wobble;    // step up: fair
+    else if (n == 80) ccs811_emu_eco2 = 3500;            // spike: poor, red LED
+    else if (n < 120) ccs811_emu_eco2 = 900 + wobble;
+    else if (n < 190) ccs811_emu_eco2 = 1234;            // moderate, stuck
+    else              ccs811_emu_eco2 = 1600 + wobble;   // poor
+}
+#endif
+
+// CSV logs (--alloc-check points them at scratch files in the temp dir)
+static QString co2LogPath   = "/root/co2_log.csv";
+static QString co2EventPath = "/root/co2_events.csv";
 
 // ----- GPIO configuration -----
 static const int RED_GPIO   = 60;   // J2 pin 6
 static const int GREEN_GPIO = 48;   // J2 pin 5
 
+static int redLedFd   = -1;
+static int greenLedFd = -1;
+static int ledState   = -1;   // bit 0 red, bit 1 green; -1 = unknown
+
+static void setAirQualityLeds(bool redOn, bool greenOn)
+{
+    // Only touch the GPIOs when the state actually changes
+    int state = (redOn ? 1 : 0) | (greenOn ? 2 : 0);
+    if (state == ledState)
+        return;
+    ledState = state;
+
+    if (redLedFd >= 0 && pwrite(redLedFd, redOn ? "1" : "0", 1, 0) != 1)
+        perror("red LED");
+    if (greenLedFd >= 0 && pwrite(greenLedFd, greenOn ? "1" : "0", 1, 0) != 1)
+        perror("green LED");
+}
+
 static void initLedGpio()
 {
     // Export GPIOs (ignore error if already exported)
@@ -38,22 +140,38 @@ static void initLedGpio()
     system("echo out > /sys/class/gpio/gpio60/direction 2>/dev/null");
     system("echo out > /sys/class/gpio/gpio48/direction 2>/dev/null");
 
+    // Keep the value files open: the per-tick LED update is then a single
+    // write() instead of a fork/exec of a shell
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/class/gpio/gpio%d/value", RED_GPIO);
+    redLedFd = open(path, O_WRONLY);
+    snprintf(path, sizeof(path), "/sys/class/gpio/gpio%d/value", GREEN_GPIO);
+    greenLedFd = open(path, O_WRONLY);
+
     // Start with both LEDs off
-    system("echo 0 > /sys/class/gpio/gpio60/value 2>/dev/null");
-    system("echo 0 > /sys/class/gpio/gpio48/value 2>/dev/null");
+    setAirQualityLeds(false, false);
 }
 
-static void setAirQualityLeds(bool redOn, bool greenOn)
+static void releaseLedGpio()
+{
+    // Turn off LEDs
+    setAirQualityLeds(false, false);
+
+    if (redLedFd >= 0)   close(redLedFd);
+    if (greenLedFd >= 0) close(greenLedFd);
+    redLedFd = greenLedFd = -1;
+
+    // Unexport GPIOs so they are clean next startup
+    system("echo 60 > /sys/class/gpio/unexport 2>/dev/null");
+    system("echo 48 > /sys/class/gpio/unexport 2>/dev/null");
+}
+
+// Overwrite a preallocated string in place. Allocation-free as long as `dst`
+// is not shared and its reserve()d capacity is large enough.
+static void assignLatin1(QString &dst, const char *src)
 {
-    if (redOn)
-        system("echo 1 > /sys/class/gpio/gpio60/value 2>/dev/null");
-    else
-        system("echo 0 > /sys/class/gpio/gpio60/value 2>/dev/null");
-
-    if (greenOn)
-        system("echo 1 > /sys/class/gpio/gpio48/value 2>/dev/null");
-    else
-        system("echo 0 > /sys/class/gpio/gpio48/value 2>/dev/null");
+    dst.resize(0);
+    dst.append(QLatin1String(src));
 }
 
 // -------- Screen Saver Widget (bouncing glowing text, with margins) --------
@@ -67,6 +185,10 @@ public:
           dx(3),
           dy(2),
           margin(10),
+          speed(1),
+          antialias(true),
+          waking(false),
+          wakePainted(false),
           titleText("CO2 MONITOR"),
           subtitleText("Touch to wake")
     {
@@ -86,17 +208,51 @@ public:
         updateTextMetrics();
 
         animTimer = new QTimer(this);
+        animTimer->setInterval(50); // ~20 FPS, started while visible
         connect(animTimer, &QTimer::timeout, this, &ScreenSaverWidget::step);
-        animTimer->start(50); // ~20 FPS
+    }
+
+    // Render quality (set by the load governor). A longer frame interval
+    // moves further per frame so the bounce keeps the same speed.
+    void setQuality(int frameMs, bool aa) {
+        speed = std::max(1, frameMs / 50);
+        antialias = aa;
+        animTimer->setInterval(frameMs);
+    }
+
+    // Fast wake: the next paint is a single blit of this pre-rendered
+    // dashboard frame; the owner hides the overlay once it has been flushed.
+    void showWakeFrame(const QPixmap &frame) {
+        wakeFrame = frame;
+        waking = true;
+        wakePainted = false;
+        animTimer->stop();
+        update();
+    }
+
+    // True once after the wake frame has been painted into the backing
+    // store. The owner checks it when the window's UpdateRequest (paint +
+    // flush to the screen) has finished.
+    bool takeWakeFramePainted() {
+        bool painted = wakePainted;
+        wakePainted = false;
+        return painted;
     }
 
 signals:
-    void userActivity();  // emitted when user taps the screen saver
+    void userActivity();      // emitted when user taps the screen saver
 
 protected:
     void paintEvent(QPaintEvent *) override {
         QPainter p(this);
-        p.setRenderHint(QPainter::Antialiasing, true);
+
+        if (waking) {
+            p.drawPixmap(0, 0, wakeFrame);
+            wakePainted = true;
+            return;
+        }
+
+        p.setRenderHint(QPainter::Antialiasing, antialias);
 
         // Background gradient
         QLinearGradient grad(rect().topLeft(), rect().bottomRight());
@@ -144,7 +300,8 @@ protected:
 
     void mousePressEvent(QMouseEvent *event) override {
         Q_UNUSED(event);
-        emit userActivity();
+        if (!waking)
+            emit userActivity();
         // Do not propagate click to underlying widgets
     }
 
@@ -154,10 +311,25 @@ protected:
         clampPosition();
     }
 
+    // Only animate while visible
+    void showEvent(QShowEvent *event) override {
+        QWidget::showEvent(event);
+        animTimer->start();
+    }
+
+    void hideEvent(QHideEvent *event) override {
+        QWidget::hideEvent(event);
+        animTimer->stop();
+
+        // Drop our reference so the owner can re-render in place
+        waking = false;
+        wakeFrame = QPixmap();
+    }
+
 private slots:
     void step() {
-        x += dx;
-        y += dy;
+        x += dx * speed;
+        y += dy * speed;
 
         QRect r = rect();
         int maxX = r.width()  - margin - textWidth;
@@ -213,6 +385,15 @@ private:
     int dx, dy;
     int margin;
 
+    // Render quality
+    int speed;
+    bool antialias;
+
+    // Fast wake
+    bool waking;
+    bool wakePainted;
+    QPixmap wakeFrame;
+
     // Text & fonts
     QString titleText;
     QString subtitleText;
@@ -234,25 +415,76 @@ class PlotWidget : public QWidget {
     Q_OBJECT
 public:
     explicit PlotWidget(double s = 1.0, QWidget *parent = nullptr)
-        : QWidget(parent), scale(s)
-    {}
+        : QWidget(parent),
+          scale(s),
+          antialias(true),
+          plotStep(1),
+          header1("CO2 Trend (ppm)")
+    {
+        // Everything paintEvent() needs is allocated once, up front
+        samples.reserve(maxPoints + 1);
+        events.reserve(maxPoints + 1);
+        poly.reserve(maxPoints);
+        textBuf.reserve(64);
+
+        axisFont = font();
+        axisFont.setPointSize(std::max(8, int(10 * scale)));
+
+        titleFont = font();
+        titleFont.setPointSize(std::max(8, int(12 * scale)));
+        titleFont.setBold(true);
+
+        statsFont = font();
+        statsFont.setPointSize(std::max(8, int(10 * scale)));
+        statsFont.setBold(false);
+    }
+
+    // Render quality (set by the load governor): polyline keeps every
+    // `step`-th sample; antialiasing off is much cheaper on the BBB.
+    void setQuality(bool aa, int step) {
+        if (aa == antialias && step == plotStep)
+            return;
+        antialias = aa;
+        plotStep = std::max(1, step);
+        update();
+    }
 
     void addSample(int value) {
         samples.append(value);
-        if (samples.size() > maxPoints)
+        events.append(ChangeDetector::None);
+        if (samples.size() > maxPoints) {
             samples.removeFirst();
+            events.removeFirst();
+        }
+        update();
+    }
+
+    // Mark a detector event on the sample `ago` samples back (0 = newest)
+    void markEvent(ChangeDetector::Event e, int ago) {
+        int i = events.size() - 1 - ago;
+        if (i < 0)
+            i = 0;   // onset scrolled out: mark the oldest visible sample
+        if (i < events.size())
+            events[i] = e;
         update();
     }
 
 protected:
-    void paintEvent(QPaintEvent *) override {
-        QPainter p(this);
+    void resizeEvent(QResizeEvent *event) override {
+        QWidget::resizeEvent(event);
 
-        // Background gradient
+        // Background gradient, rebuilt only when the geometry changes
         QLinearGradient grad(rect().topLeft(), rect().bottomRight());
         grad.setColorAt(0.0, QColor("#101525"));
         grad.setColorAt(1.0, QColor("#050812"));
-        p.fillRect(rect(), grad);
+        background = QBrush(grad);
+    }
+
+    void paintEvent(QPaintEvent *) override {
+        QPainter p(this);
+
+        // Background gradient
+        p.fillRect(rect(), background);
 
         if (samples.isEmpty())
             return;
@@ -284,7 +516,7 @@ protected:
         double avg = sum / samples.size();
 
         // ----- Draw background grid in plot area -----
-        p.setRenderHint(QPainter::Antialiasing, true);
+        p.setRenderHint(QPainter::Antialiasing, antialias);
         p.setPen(QColor(255, 255, 255, 30));
 
         int gridLines = 3;
@@ -297,9 +529,7 @@ protected:
         p.setPen(QColor(255, 255, 255, 120));
         p.drawLine(leftMargin, topMargin, leftMargin, topMargin + plotH);  // main axis
 
-        QFont axisFont = p.font();
-        int axisFontSize = std::max(8, int(10 * scale));
-        axisFont.setPointSize(axisFontSize);
+        int axisFontSize = axisFont.pointSize();
         p.setFont(axisFont);
 
         int tickCount = 4;  // 0%, 33%, 66%, 100%
@@ -312,25 +542,51 @@ protected:
 
             // label value
             int val = minVal + t * (maxVal - minVal);
-            QString label = QString::number(val);
+            char label[16];
+            snprintf(label, sizeof(label), "%d", val);
+            assignLatin1(textBuf, label);
             QRect textRect(0, yTick - axisFontSize, leftMargin - 6, axisFontSize * 2);
-            p.drawText(textRect, Qt::AlignRight | Qt::AlignVCenter, label);
+            p.drawText(textRect, Qt::AlignRight | Qt::AlignVCenter, textBuf);
         }
 
         // ----- Polyline for raw values -----
-        QPolygon poly;
         int n = samples.size();
-        for (int i = 0; i < n; i++) {
+        auto pointAt = [&](int i) {
             double x = leftMargin + (double)i / (n - 1) * plotW;
             double norm = (samples[i] - minVal) / double(maxVal - minVal);
             double y = topMargin + (1.0 - norm) * plotH;
-            poly << QPoint((int)x, (int)y);
-        }
+            return QPoint((int)x, (int)y);
+        };
+
+        // Decimated: every plotStep-th sample, always ending on the newest
+        poly.resize(0);   // keeps the reserved capacity
+        for (int i = (n - 1) % plotStep; i < n; i += plotStep)
+            poly << pointAt(i);
 
         // Raw data line
         p.setPen(QColor("#00e676"));
         p.drawPolyline(poly);
 
+        // ----- Detector event markers -----
+        for (int i = 0; i < n; i++) {
+            if (events[i] == ChangeDetector::None)
+                continue;
+
+            QColor c;
+            switch (events[i]) {
+            case ChangeDetector::Spike: c = QColor("#e040fb"); break;
+            case ChangeDetector::Stuck: c = QColor("#9e9e9e"); break;
+            default:                    c = QColor("#ff9100"); break;   // steps
+            }
+            QPoint pt = pointAt(i);
+            p.setPen(QColor(c.red(), c.green(), c.blue(), 110));
+            p.drawLine(pt.x(), topMargin, pt.x(), topMargin + plotH);
+            p.setPen(Qt::NoPen);
+            p.setBrush(c);
+            p.drawEllipse(pt, 3, 3);
+            p.setBrush(Qt::NoBrush);
+        }
+
         // ----- Average horizontal line -----
         double normAvg = (avg - minVal) / double(maxVal - minVal);
         double yAvg = topMargin + (1.0 - normAvg) * plotH;
@@ -342,36 +598,273 @@ protected:
         p.drawRoundedRect(rect().adjusted(3, 3, -3, -3), 12, 12);
 
         // ----- Header text (outside the plot area, not盖在线上) -----
-        QFont titleFont = p.font();
-        int titleSize = std::max(8, int(12 * scale));
-        titleFont.setPointSize(titleSize);
-        titleFont.setBold(true);
         p.setFont(titleFont);
-
-        QString header1 = "CO2 Trend (ppm)";
         p.setPen(Qt::white);
         p.drawText(leftMargin, topMargin - 14, header1);
 
-        QFont statsFont = p.font();
-        int statsSize = std::max(8, int(10 * scale));
-        statsFont.setPointSize(statsSize);
-        statsFont.setBold(false);
         p.setFont(statsFont);
 
-        QString header2 = QString("Min: %1   Avg(60s): %2   Max: %3")
-                              .arg(minVal)
-                              .arg((int)avg)
-                              .arg(maxVal);
+        char header2[64];
+        snprintf(header2, sizeof(header2), "Min: %d   Avg(60s): %d   Max: %d",
+                 minVal, (int)avg, maxVal);
+        assignLatin1(textBuf, header2);
         p.setPen(QColor(200, 220, 255));
-        p.drawText(leftMargin, topMargin - 2, header2);
+        p.drawText(leftMargin, topMargin - 2, textBuf);
     }
 
 private:
     QVector<int> samples;
+    QVector<int> events;        // ChangeDetector::Event per sample
     const int maxPoints = 60;   // last ~60 seconds
     double scale;
+    bool antialias;
+    int plotStep;
+
+    // Preallocated paint resources
+    QPolygon poly;
+    QFont axisFont;
+    QFont titleFont;
+    QFont statsFont;
+    const QString header1;
+    QString textBuf;
+    QBrush background;
+};
+
+
+// -------- Load-shedding governor --------
+// Samples process CPU time and event-loop lag twice a second and steps the
+// render quality down under pressure / back up once things are calm again.
+// It only ever touches rendering; sensor sampling and logging are untouched.
+class LoadGovernor : public QObject {
+    Q_OBJECT
+public:
+    struct Level {
+        const char *name;
+        int animFrameMs;    // screen saver frame interval
+        bool antialias;
+        int plotStep;       // trend polyline decimation
+        int labelEvery;     // update dashboard labels every N sensor ticks
+        int wakeFrameMs;    // min interval between wake frame re-renders (screen saver up)
+    };
+
+    explicit LoadGovernor(QObject *parent = nullptr)
+        : QObject(parent),
+          current(0),
+          pressured(0),
+          calm(0),
+          cpuLoad(0.0),
+          loopLagMs(0),
+          samplesSinceReport(0),
+          lastCpuNs(0)
+    {
+        lastCpuNs = processCpuNs();
+        wall.start();
+
+        sampleTimer = new QTimer(this);
+        sampleTimer->setTimerType(Qt::PreciseTimer);
+        connect(sampleTimer, &QTimer::timeout, this, &LoadGovernor::sample);
+        sampleTimer->start(periodMs);
+    }
+
+    static int levelCount() { return 4; }
+
+    static const Level &levelInfo(int i) {
+        static const Level levels[] = {
+            { "full",    50,  true,  1, 1, 1000 },
+            { "reduced", 100, true,  1, 1, 2000 },
+            { "low",     200, false, 2, 2, 5000 },
+            { "minimal", 500, false, 4, 5, 10000 },
+        };
+        return levels[std::max(0, std::min(i, levelCount() - 1))];
+    }
+
+    int level() const { return current; }
+
+    // Last sample, for inspection between transitions
+    double lastCpuPercent() const { return cpuLoad * 100.0; }
+    int lastLoopLagMs() const { return loopLagMs; }
+
+signals:
+    void levelChanged(int level);
+
+private slots:
+    void sample() {
+        qint64 elapsedMs = wall.restart();
+        qint64 cpuNs = processCpuNs();
+
+        // CPU share of this process over the last period (single core board)
+        cpuLoad = elapsedMs > 0 ? double(cpuNs - lastCpuNs) / (elapsedMs * 1e6) : 0.0;
+        lastCpuNs = cpuNs;
+
+        // How late this timer fired = how long the event loop was busy
+        loopLagMs = int(std::max<qint64>(0, elapsedMs - periodMs));
+
+        if (cpuLoad > 0.6 || loopLagMs > 50) {
+            calm = 0;
+            if (++pressured >= 2 && current < levelCount() - 1) {
+                setLevel(current + 1);
+                pressured = 0;
+            }
+        } else if (cpuLoad < 0.3 && loopLagMs < 10) {
+            pressured = 0;
+            if (++calm >= 10 && current > 0) {   // ~5 s of calm per step
+                setLevel(current - 1);
+                calm = 0;
+            }
+        } else {
+            pressured = calm = 0;
+        }
+
+        // Current level every ~30 s, so a board can be inspected at any time
+        if (++samplesSinceReport >= reportEvery) {
+            samplesSinceReport = 0;
+            qInfo("governor: level %s (cpu %.0f%%, loop lag %d ms)",
+                  levelInfo(current).name, lastCpuPercent(), loopLagMs);
+        }
+    }
+
+private:
+    static qint64 processCpuNs() {
+        struct timespec ts;
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+        return qint64(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+    }
+
+    void setLevel(int l) {
+        qInfo("governor: level %s -> %s (cpu %.0f%%, loop lag %d ms)",
+              levelInfo(current).name, levelInfo(l).name,
+              cpuLoad * 100.0, loopLagMs);
+        current = l;
+        emit levelChanged(current);
+    }
+
+    static const int periodMs = 500;
+    static const int reportEvery = 60;   // samples between level reports
+
+    int current;
+    int pressured;      // consecutive samples under pressure
+    int calm;           // consecutive calm samples
+    double cpuLoad;
+    int loopLagMs;
+    int samplesSinceReport;
+    qint64 lastCpuNs;
+    QElapsedTimer wall;
+    QTimer *sampleTimer;
+};
+
+// -------- Wake latency tracing --------
+// Log2-bucketed histogram in microseconds: fixed size, O(1) per sample.
+class LatencyHistogram {
+public:
+    LatencyHistogram() : count(0), sumUs(0), maxUs(0) {
+        std::fill(buckets, buckets + bucketCount, 0);
+    }
+
+    void record(qint64 us) {
+        us = std::max<qint64>(0, us);
+        int b = 0;
+        while (b < bucketCount - 1 && (qint64(1) << b) <= us)
+            ++b;
+        ++buckets[b];
+        ++count;
+        sumUs += us;
+        maxUs = std::max(maxUs, us);
+    }
+
+    // Upper bound of the bucket holding the given percentile
+    qint64 percentile(double pct) const {
+        long target = long(std::ceil(count * pct / 100.0));
+        long seen = 0;
+        for (int b = 0; b < bucketCount; ++b) {
+            seen += buckets[b];
+            if (seen >= target && seen > 0)
+                return qint64(1) << b;
+        }
+        return maxUs;
+    }
+
+    void print(const char *name) const {
+        fprintf(stderr, "%-14s n=%ld  mean %lld us  p50 <%lld us  p95 <%lld us  max %lld us\n",
+                name, count, count ? (long long)(sumUs / count) : 0LL,
+                (long long)percentile(50), (long long)percentile(95), (long long)maxUs);
+    }
+
+private:
+    static const int bucketCount = 24;   // up to ~8 s
+    long buckets[bucketCount];
+    long count;
+    qint64 sumUs;
+    qint64 maxUs;
+};
+
+// Stages of a tap: input dispatched by QApplication -> handler -> first
+// flush of the resulting frame to the screen. One tracer per kind of tap
+// (touch-to-wake, dashboard buttons), each with its own histograms.
+// (Kernel -> Qt delivery is not visible from here: event timestamps use
+// the platform plugin's own clock.)
+class InputTracer {
+public:
+    explicit InputTracer(const char *name) : name(name), inputNs(-1), handlerNs(-1) {
+        clock.start();
+    }
+
+    void markInput() {
+        // Touch begin + synthesized mouse press (and the same event seen on
+        // its way through the widget tree) arrive together: keep the first.
+        // An input that never reached a handler is dropped once stale.
+        qint64 now = clock.nsecsElapsed();
+        if (inputNs < 0 || (handlerNs < 0 && now - inputNs > staleNs))
+            inputNs = now;
+    }
+
+    void markHandler() {
+        handlerNs = clock.nsecsElapsed();
+        if (inputNs < 0)
+            inputNs = handlerNs;
+    }
+
+    // Called once the top-level window has flushed; only counts if a
+    // handler ran since the input
+    void markPainted() {
+        if (handlerNs < 0)
+            return;
+        qint64 paintedNs = clock.nsecsElapsed();
+        qint64 toHandler = (handlerNs - inputNs) / 1000;
+        qint64 toPaint   = (paintedNs - handlerNs) / 1000;
+        qint64 total     = (paintedNs - inputNs) / 1000;
+        inputToHandler.record(toHandler);
+        handlerToPaint.record(toPaint);
+        inputToPaint.record(total);
+        qInfo("%s: input->handler %lld us, handler->paint %lld us, total %lld us",
+              name, (long long)toHandler, (long long)toPaint, (long long)total);
+        inputNs = handlerNs = -1;
+    }
+
+    // Forget a half-traced tap (e.g. one that arrived mid-wake)
+    void cancel() { inputNs = handlerNs = -1; }
+
+    void report() const {
+        fprintf(stderr, "%s:\n", name);
+        inputToHandler.print("input->handler");
+        handlerToPaint.print("handler->paint");
+        inputToPaint.print("input->paint");
+    }
+
+private:
+    static const qint64 staleNs = 250 * 1000000LL;
+
+    const char *name;
+    QElapsedTimer clock;
+    qint64 inputNs;
+    qint64 handlerNs;
+    LatencyHistogram inputToHandler;
+    LatencyHistogram handlerToPaint;
+    LatencyHistogram inputToPaint;
 };
 
+#ifdef CO2_WAKE_REPLAY
+static int wakeReplayCount = 0;   // --wake-replay N: synthetic taps, then exit
+#endif
 
 class MainWindow : public QWidget {
     Q_OBJECT
@@ -381,7 +874,12 @@ public:
           screenSaver(nullptr),
           idleTimer(nullptr),
           inScreenSaver(false),
-          logFile(nullptr)
+          wakeFrameTimer(nullptr),
+          governor(nullptr),
+          tickCount(0),
+          lastQuality(-1),
+          logFile(nullptr),
+          eventFile(nullptr)
     {
         // ==== Auto scale based on screen height (reference 480) ====
         int H = QApplication::primaryScreen()->size().height();
@@ -414,12 +912,14 @@ public:
             "border-radius: 14px; border: 1px solid rgba(255,255,255,40); }");
 
         co2Label = new QLabel("CO2: -- ppm");
+        co2Label->setTextFormat(Qt::PlainText);
         co2Label->setAlignment(Qt::AlignCenter);
         co2Label->setStyleSheet(
             QString("font-size:%1px; font-weight:600; color:#00e676;")
                 .arg(co2FontSize));
 
         statusLabel = new QLabel("Initializing sensor...");
+        statusLabel->setTextFormat(Qt::PlainText);
         statusLabel->setAlignment(Qt::AlignCenter);
         statusLabel->setWordWrap(true);
         statusLabel->setMaximumWidth(440);
@@ -509,12 +1009,11 @@ public:
         connect(showTrendBtn, &QPushButton::clicked, this, &MainWindow::showTrendPage);
         connect(backBtn,      &QPushButton::clicked, this, &MainWindow::showDashboardPage);
         connect(exitBtn, &QPushButton::clicked, this, []() {
-            // Turn off LEDs
-            setAirQualityLeds(false, false);
+            // Keep the latest CCS811 baseline for the next startup
+            ccs811_save_baseline();
 
-            // Optionally unexport GPIOs so they are clean next startup
-            system("echo 60 > /sys/class/gpio/unexport 2>/dev/null");
-            system("echo 48 > /sys/class/gpio/unexport 2>/dev/null");
+            // Turn off LEDs and unexport GPIOs
+            releaseLedGpio();
 
             // Clear framebuffer
             system("dd if=/dev/zero of=/dev/fb0 bs=1024 count=512 >/dev/null 2>&1");
@@ -535,21 +1034,47 @@ public:
         initLedGpio();
 
         // ==== CSV LOGGING ====
-        logFile = new QFile("/root/co2_log.csv", this);
-        if (logFile->open(QIODevice::Append | QIODevice::Text)) {
-            logStream.setDevice(logFile);
-            if (logFile->size() == 0) {
-                logStream << "timestamp,co2_ppm\n";
-                logStream.flush();
-            }
+        // Unbuffered: each line is formatted into a stack buffer and goes
+        // straight to write(), with no stream or codec buffers in between
+        logFile = new QFile(co2LogPath, this);
+        if (logFile->open(QIODevice::Append | QIODevice::Text | QIODevice::Unbuffered)) {
+            if (logFile->size() == 0)
+                logFile->write("timestamp,co2_ppm\n");
         } else {
             statusLabel->setText("Sensor OK, but failed to open log file.");
         }
 
+        // ==== EVENT LOG (detector output) ====
+        eventFile = new QFile(co2EventPath, this);
+        if (eventFile->open(QIODevice::Append | QIODevice::Text | QIODevice::Unbuffered)) {
+            if (eventFile->size() == 0)
+                eventFile->write("timestamp,event,co2_ppm,onset_samples\n");
+        }
+
+        // ==== Preallocated per-tick strings ====
+        for (int i = 0; i < qualityLevels; ++i) {
+            co2Styles[i] = QString("font-size:%1px; color:%2;")
+                               .arg(co2FontSize).arg(qualityColors[i]);
+        }
+        for (int i = 0; i < 2; ++i) {
+            co2Text[i].reserve(32);
+            statusText[i].reserve(96);
+        }
+
         // ==== Timer ====
         timer = new QTimer(this);
+        timer->setTimerType(Qt::PreciseTimer);
         connect(timer, &QTimer::timeout, this, &MainWindow::updateSensor);
         timer->start(1000);
+#ifdef CO2_COUNT_ALLOCS
+        if (allocCheckTicks > 0)
+            timer->setInterval(50);   // scripted sensor: no need to wait
+#endif
+
+        // ==== CCS811 baseline: save hourly so a reboot can restore it ====
+        baselineTimer = new QTimer(this);
+        connect(baselineTimer, &QTimer::timeout, this, []() { ccs811_save_baseline(); });
+        baselineTimer->start(3600 * 1000);
 
         // ==== ScreenSaver ====
         screenSaver = new ScreenSaverWidget(this);
@@ -560,10 +1085,44 @@ public:
         connect(screenSaver, &ScreenSaverWidget::userActivity,
                 this, &MainWindow::onScreenSaverUserActivity);
 
+        // Timestamp taps as soon as QApplication dispatches them
+        qApp->installEventFilter(this);
+
+        // Wake frame re-render after a new reading, only while the screen
+        // saver is up and at most as often as the governor allows
+        wakeFrameTimer = new QTimer(this);
+        wakeFrameTimer->setSingleShot(true);
+        connect(wakeFrameTimer, &QTimer::timeout, this, &MainWindow::refreshWakeFrame);
+        wakeFrameAge.start();
+
+        // A wake whose frame never reaches the screen must not leave the
+        // overlay up (it ignores taps while waking)
+        wakeTimeout = new QTimer(this);
+        wakeTimeout->setSingleShot(true);
+        wakeTimeout->setInterval(500);
+        connect(wakeTimeout, &QTimer::timeout, this, [this]() {
+            qWarning("wake: frame not flushed after %d ms, closing the screen saver",
+                     wakeTimeout->interval());
+            wakeTracer.cancel();
+            stopScreenSaver();
+        });
+
         idleTimer = new QTimer(this);
         idleTimer->setInterval(15000);
         connect(idleTimer, &QTimer::timeout, this, &MainWindow::startScreenSaver);
         idleTimer->start();
+
+        // ==== Load governor: trade render quality for timely sampling ====
+        governor = new LoadGovernor(this);
+        connect(governor, &LoadGovernor::levelChanged, this, &MainWindow::applyRenderQuality);
+
+#ifdef CO2_WAKE_REPLAY
+        if (wakeReplayCount > 0) {
+            replayTimer = new QTimer(this);
+            connect(replayTimer, &QTimer::timeout, this, &MainWindow::wakeReplayStep);
+            replayTimer->start(300);
+        }
+#endif
     }
 
 protected:
@@ -577,59 +1136,161 @@ protected:
         QWidget::mousePressEvent(event);
     }
 
+    // Timestamp taps as soon as QApplication dispatches them. The screen
+    // saver wakes on press; dashboard buttons act on release.
+    bool eventFilter(QObject *watched, QEvent *event) override {
+        QEvent::Type type = event->type();
+        if (inScreenSaver) {
+            if (type == QEvent::MouseButtonPress || type == QEvent::TouchBegin)
+                wakeTracer.markInput();
+        } else if (type == QEvent::MouseButtonRelease || type == QEvent::TouchEnd) {
+            tapTracer.markInput();
+        }
+        return QWidget::eventFilter(watched, event);
+    }
+
+    // The top-level UpdateRequest paints dirty widgets and flushes the
+    // backing store to the screen; whatever a handler changed is only
+    // visible once QWidget::event() returns.
+    bool event(QEvent *event) override {
+        bool handled = QWidget::event(event);
+        if (event->type() == QEvent::UpdateRequest) {
+            tapTracer.markPainted();
+            if (screenSaver && screenSaver->takeWakeFramePainted())
+                onWakeFrameFlushed();
+        }
+        return handled;
+    }
+
 private slots:
     void updateSensor() {
+#ifdef CO2_COUNT_ALLOCS
+        if (allocCheckTicks > 0)
+            allocCheckDriveSensor(tickCount);
+        long allocsAtStart = threadAllocCount();
+#endif
         int v = read_co2_ppm();
         if (v < 0) {
             statusLabel->setText("Read error.");
             return;
         }
 
-        QString tsLog = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss");
-        QString t     = QDateTime::currentDateTime().toString("hh:mm:ss");
-
-        // Update CO2 text
-        co2Label->setText(QString("CO2: %1 ppm").arg(v));
-
-        QString quality;
-        if (v > 1500) {
-            co2Label->setStyleSheet(QString("font-size:%1px; color:#ff5252;").arg(co2FontSize));
-            quality = "Poor";
-        } else if (v > 1000) {
-            co2Label->setStyleSheet(QString("font-size:%1px; color:#ffb300;").arg(co2FontSize));
-            quality = "Moderate";
-        } else if (v > 800) {
-            co2Label->setStyleSheet(QString("font-size:%1px; color:#ffeb3b;").arg(co2FontSize));
-            quality = "Fair";
-        } else {
-            co2Label->setStyleSheet(QString("font-size:%1px; color:#00e676;").arg(co2FontSize));
-            quality = "Good";
+        // Timestamps into fixed buffers (QDateTime::toString allocates)
+        char tsLog[32];
+        char t[16];
+        time_t now = time(nullptr);
+        struct tm tmNow;
+        localtime_r(&now, &tmNow);
+        strftime(tsLog, sizeof(tsLog), "%Y-%m-%d %H:%M:%S", &tmNow);
+        strftime(t, sizeof(t), "%H:%M:%S", &tmNow);
+
+        char line[96];
+
+        // ==== WRITE CSV LOG ==== (first, so rendering never delays it)
+        if (logFile && logFile->isOpen()) {
+            int len = snprintf(line, sizeof(line), "%s,%d\n", tsLog, v);
+            logFile->write(line, len);
         }
 
-        statusLabel->setText(
-            QString("Air Quality: %1\nUpdated at %2")
-                .arg(quality).arg(t));
+        int conditioning = ccs811_conditioning_remaining();
 
-        plotWidget->addSample(v);
-        
-        // ----- External LED logic -----
+        // ----- External LED logic (stays active while conditioning) -----
         if (v > 3000) {
             setAirQualityLeds(true, false);   // red ON, green OFF
         } else {
             setAirQualityLeds(false, true);   // green ON, red OFF
         }
 
-        // ==== WRITE CSV LOG ====
-        if (logFile && logFile->isOpen()) {
-            logStream << tsLog << "," << v << "\n";
-            logStream.flush();
+        // ----- Change / anomaly detection -----
+        ChangeDetector::Event ev = detector.addSample(v);
+        if (ev != ChangeDetector::None) {
+            if (eventFile && eventFile->isOpen()) {
+                int len = snprintf(line, sizeof(line), "%s,%s,%d,%d\n", tsLog,
+                                   ChangeDetector::eventName(ev), v, detector.onset());
+                eventFile->write(line, len);
+            }
         }
+
+        // ----- Dashboard text -----
+        int level;
+        char quality[48];
+        if (conditioning > 0) {
+            // Baseline not settled yet: show the value, but don't judge it
+            level = 0;
+            snprintf(quality, sizeof(quality), "Conditioning (%d min left)",
+                     (conditioning + 59) / 60);
+        } else {
+            level = v > 1500 ? 1 : v > 1000 ? 2 : v > 800 ? 3 : 4;
+            snprintf(quality, sizeof(quality), "%s", qualityNames[level]);
+        }
+
+        snprintf(co2Buf, sizeof(co2Buf), "CO2: %d ppm", v);
+        snprintf(statusBuf, sizeof(statusBuf), "Air Quality: %s\nUpdated at %s", quality, t);
+
+        // Label refresh rate is throttled by the load governor
+        bool qualityChanged = level != lastQuality;
+        ++tickCount;
+        int labelEvery = LoadGovernor::levelInfo(governor->level()).labelEvery;
+        bool newCo2 = false, newStatus = false;
+        if (qualityChanged || tickCount % labelEvery == 0) {
+            newCo2    = stageLabelText(co2Label, co2Text, co2TextIdx, co2Buf);
+            newStatus = stageLabelText(statusLabel, statusText, statusTextIdx, statusBuf);
+        }
+
+#ifdef CO2_COUNT_ALLOCS
+        long dataAllocs = threadAllocCount() - allocsAtStart;
+        long allocsAtUi = threadAllocCount();
+#endif
+
+        // ----- Qt widget updates -----
+        plotWidget->addSample(v);
+        if (ev != ChangeDetector::None)
+            plotWidget->markEvent(ev, detector.onset());
+
+        // Restyling is expensive: only when the quality level changes
+        if (qualityChanged) {
+            co2Label->setStyleSheet(co2Styles[level]);
+            lastQuality = level;
+        }
+
+        if (newCo2)
+            co2Label->setText(co2Text[co2TextIdx]);
+        if (newStatus)
+            statusLabel->setText(statusText[statusTextIdx]);
+
+        // New reading: the wake frame no longer shows the latest state
+        if (inScreenSaver)
+            scheduleWakeFrame();
+
+#ifdef CO2_COUNT_ALLOCS
+        long uiAllocs = threadAllocCount() - allocsAtUi;
+        checkTickAllocs(dataAllocs, uiAllocs);
+#endif
+    }
+
+    void applyRenderQuality(int level) {
+        const LoadGovernor::Level &q = LoadGovernor::levelInfo(level);
+        screenSaver->setQuality(q.animFrameMs, q.antialias);
+        plotWidget->setQuality(q.antialias, q.plotStep);
+    }
+
+    void showTrendPage() {
+        tapTracer.markHandler();
+        stack->setCurrentIndex(1);
     }
 
-    void showTrendPage() { stack->setCurrentIndex(1); }
-    void showDashboardPage() { stack->setCurrentIndex(0); }
+    void showDashboardPage() {
+        tapTracer.markHandler();
+        stack->setCurrentIndex(0);
+    }
 
     void startScreenSaver() {
+        if (inScreenSaver)
+            return;
+        idleTimer->stop();
+        wakeFrameDirty = true;
+        refreshWakeFrame();
+        wakeTracer.cancel();
         inScreenSaver = true;
         screenSaver->show();
         screenSaver->raise();
@@ -637,29 +1298,239 @@ private slots:
 
     void stopScreenSaver() {
         inScreenSaver = false;
+        wakeFrameTimer->stop();
+        wakeTimeout->stop();
+        applyLatestLabels();
         screenSaver->hide();
     }
 
     void onScreenSaverUserActivity() {
-        stopScreenSaver();
+        wakeTracer.markHandler();
+        wakeFrameTimer->stop();
+        // Blit the pre-rendered frame first; the overlay is hidden (and the
+        // live dashboard repainted underneath) only once that is on screen.
+        // A frame older than the latest reading is re-rendered first, so
+        // the live dashboard never jumps when it takes over.
+        if (wakeFrame.size() != size())
+            wakeFrameDirty = true;
+        refreshWakeFrame();
+        screenSaver->showWakeFrame(wakeFrame);
+        wakeTimeout->start();
         idleTimer->start(15000);
     }
 
+    // Under the screen saver the labels are hidden and only feed the wake
+    // frame: bring them up to the latest reading and re-render, if it moved
+    void refreshWakeFrame() {
+        if (!wakeFrameDirty)
+            return;
+        applyLatestLabels();
+        renderWakeFrame();
+        wakeFrameDirty = false;
+        wakeFrameAge.restart();
+    }
+
+#ifdef CO2_WAKE_REPLAY
+    // Synthetic taps for latency measurement (e.g. -platform offscreen),
+    // queued through the platform input path like a real touch
+    void wakeReplayStep() {
+        if (!inScreenSaver) {
+            if (wakesReplayed >= wakeReplayCount) {
+                replayTimer->stop();
+                wakeTracer.report();
+                tapTracer.report();
+                qApp->exit(0);
+                return;
+            }
+            startScreenSaver();
+            return;
+        }
+
+        QWindow *win = windowHandle();
+        if (!win)
+            return;
+        QPoint local = screenSaver->mapTo(this, screenSaver->rect().center());
+        QPointF global = mapToGlobal(local);
+        wakeTracer.markInput();
+        QWindowSystemInterface::handleMouseEvent(win, local, global, Qt::LeftButton,
+                                                 Qt::LeftButton, QEvent::MouseButtonPress);
+        QWindowSystemInterface::handleMouseEvent(win, local, global, Qt::NoButton,
+                                                 Qt::LeftButton, QEvent::MouseButtonRelease);
+        ++wakesReplayed;
+    }
+#endif
+
 private:
+    // Re-render once the governor's minimum interval since the last render
+    // has passed; readings in between only keep the frame marked dirty
+    void scheduleWakeFrame() {
+        wakeFrameDirty = true;
+        if (wakeFrameTimer->isActive())
+            return;
+        int interval = LoadGovernor::levelInfo(governor->level()).wakeFrameMs;
+        qint64 wait = std::max<qint64>(0, interval - wakeFrameAge.elapsed());
+        wakeFrameTimer->start(int(wait));
+    }
+
+    void onWakeFrameFlushed() {
+        wakeTimeout->stop();
+        wakeTracer.markPainted();
+        QTimer::singleShot(0, this, &MainWindow::stopScreenSaver);
+    }
+
+    // Bring the labels up to the latest formatted reading
+    void applyLatestLabels() {
+        if (co2Buf[0] && stageLabelText(co2Label, co2Text, co2TextIdx, co2Buf))
+            co2Label->setText(co2Text[co2TextIdx]);
+        if (statusBuf[0] && stageLabelText(statusLabel, statusText, statusTextIdx, statusBuf))
+            statusLabel->setText(statusText[statusTextIdx]);
+    }
+
+    // Pre-render the dashboard (everything but the overlay) for fast wake.
+    // The pixmap is reused; the screen saver drops its copy when hidden.
+    void renderWakeFrame() {
+        if (wakeFrame.size() != size())
+            wakeFrame = QPixmap(size());
+        wakeFrame.fill(palette().color(QPalette::Window));
+        titleLabel->render(&wakeFrame, titleLabel->pos());
+        stack->render(&wakeFrame, stack->pos());
+    }
+
+    // QLabel keeps a shared copy of its last text, so alternate between two
+    // preallocated buffers: the one written is never the one the label holds.
+    // Returns false (and stages nothing) if the label already shows `text`;
+    // otherwise the caller passes bufs[cur] to QLabel::setText().
+    static bool stageLabelText(QLabel *label, QString *bufs, int &cur, const char *text) {
+        if (label->text() == QLatin1String(text))
+            return false;
+        cur ^= 1;
+        assignLatin1(bufs[cur], text);
+        return true;
+    }
+
+#ifdef CO2_COUNT_ALLOCS
+    // A whole tick is measured in three parts:
+    //   data path  - read, log, LEDs, detector, text formatting and staging
+    //                into the label buffers: asserted to be zero;
+    //   widgets    - plot sample, setStyleSheet/setText, update requests:
+    //                Qt-internal allocations, reported only;
+    //   plot paint - PlotWidget forced to paint into a preallocated image:
+    //                QPainter/text layout allocations, reported only.
+    // Steady state = after a short warm-up (caches, first style polish, ...)
+    void checkTickAllocs(long dataAllocs, long uiAllocs) {
+        const int warmupTicks = 5;
+
+        long paintAllocs = 0;
+        if (!plotWidget->size().isEmpty()) {
+            if (plotProbe.size() != plotWidget->size())
+                plotProbe = QImage(plotWidget->size(), QImage::Format_ARGB32_Premultiplied);
+            long allocsAtPaint = threadAllocCount();
+            plotWidget->render(&plotProbe);
+            paintAllocs = threadAllocCount() - allocsAtPaint;
+        }
+
+        ++allocTicks;
+        fprintf(stderr, "alloc: tick %d: data path %ld, widgets %ld, plot paint %ld\n",
+                allocTicks, dataAllocs, uiAllocs, paintAllocs);
+        if (allocTicks > warmupTicks && dataAllocs != 0)
+            allocFailures++;
+
+        // Which data path branches this tick took, from their side effects
+        qint64 logSize   = logFile->isOpen() ? logFile->size() : -1;
+        qint64 eventSize = eventFile->isOpen() ? eventFile->size() : -1;
+        if (allocTicks > warmupTicks) {
+            covTicks[CovCsv]     += logSize > covLogSize;
+            covTicks[CovEvent]   += eventSize > covEventSize;
+            covTicks[CovLed]     += ledState != covLed;
+            covTicks[CovQuality] += lastQuality != covQuality;
+            covTicks[CovLabel]   += co2TextIdx != covCo2Idx;
+        }
+        covLogSize = logSize;
+        covEventSize = eventSize;
+        covLed = ledState;
+        covQuality = lastQuality;
+        covCo2Idx = co2TextIdx;
+
+        if (allocCheckTicks > 0 && allocTicks >= allocCheckTicks) {
+            static const char *const covNames[CovCount] = {
+                "CSV log write", "event log write", "LED change",
+                "quality change", "label text staged"
+            };
+            int uncovered = 0;
+            for (int i = 0; i < CovCount; ++i) {
+                fprintf(stderr, "alloc: %-17s in %d tick(s)\n", covNames[i], covTicks[i]);
+                uncovered += covTicks[i] == 0;
+            }
+            fprintf(stderr, "alloc: %d of %d steady-state ticks allocated in the data path\n",
+                    allocFailures, allocTicks - warmupTicks);
+            if (uncovered)
+                fprintf(stderr, "alloc: %d branch(es) never ran; use more ticks\n", uncovered);
+            qApp->exit(allocFailures || uncovered ? 1 : 0);
+        }
+    }
+
+    int allocTicks = 0;
+    int allocFailures = 0;
+    QImage plotProbe;
+
+    // Data path branches seen in steady-state ticks
+    enum { CovCsv, CovEvent, CovLed, CovQuality, CovLabel, CovCount };
+    int covTicks[CovCount] = {};
+    qint64 covLogSize = -1;
+    qint64 covEventSize = -1;
+    int covLed = -1;
+    int covQuality = -1;
+    int covCo2Idx = -1;
+#endif
+
     QLabel *titleLabel;
     QLabel *co2Label;
     QLabel *statusLabel;
     QStackedWidget *stack;
     PlotWidget *plotWidget;
     QTimer *timer;
+    QTimer *baselineTimer;
 
     ScreenSaverWidget *screenSaver;
     QTimer *idleTimer;
     bool inScreenSaver;
 
+    // ===== Fast wake / latency tracing =====
+    QPixmap wakeFrame;
+    bool wakeFrameDirty = true;     // a reading arrived since the last render
+    QElapsedTimer wakeFrameAge;
+    QTimer *wakeFrameTimer;
+    QTimer *wakeTimeout = nullptr;
+    InputTracer wakeTracer{"wake"};
+    InputTracer tapTracer{"tap"};
+#ifdef CO2_WAKE_REPLAY
+    QTimer *replayTimer = nullptr;
+    int wakesReplayed = 0;
+#endif
+
+    // ===== Load shedding =====
+    LoadGovernor *governor;
+    int tickCount;
+    int lastQuality;    // index of the current air-quality level
+
     // ===== CSV LOGGING =====
     QFile *logFile;
-    QTextStream logStream;
+
+    // ===== Change / anomaly detection =====
+    ChangeDetector detector;
+    QFile *eventFile;
+
+    // ===== Preallocated per-tick strings =====
+    static const int qualityLevels = 5;
+    static const char *const qualityNames[qualityLevels];
+    static const char *const qualityColors[qualityLevels];
+    QString co2Styles[qualityLevels];
+    QString co2Text[2];
+    QString statusText[2];
+    int co2TextIdx = 0;
+    int statusTextIdx = 0;
+    char co2Buf[32] = "";       // latest formatted reading (labels may lag it)
+    char statusBuf[96] = "";
 
     // Scaling
     double scale;
@@ -670,10 +1541,44 @@ private:
     int hintFontSize;
 };
 
+// Index 0 is the "conditioning" state (see ccs811_conditioning_remaining)
+const char *const MainWindow::qualityNames[MainWindow::qualityLevels] =
+    { "Conditioning", "Poor", "Moderate", "Fair", "Good" };
+const char *const MainWindow::qualityColors[MainWindow::qualityLevels] =
+    { "#b0b5ff", "#ff5252", "#ffb300", "#ffeb3b", "#00e676" };
+
 int main(int argc, char *argv[])
 {
+    if (argc == 3 && strcmp(argv[1], "--replay") == 0)
+        return replayLog(argv[2]);
+
     QApplication app(argc, argv);
 
+#ifdef CO2_WAKE_REPLAY
+    // --wake-replay N: N synthetic touch-to-wake cycles, then print the
+    // latency histograms and exit
+    int wakeArg = app.arguments().indexOf("--wake-replay");
+    if (wakeArg > 0 && wakeArg + 1 < app.arguments().size())
+        wakeReplayCount = app.arguments().at(wakeArg + 1).toInt();
+#endif
+
+#ifdef CO2_COUNT_ALLOCS
+    // --alloc-check N: run N sensor ticks, exit non-zero if any steady-state
+    // tick allocated in the data path
+    int checkArg = app.arguments().indexOf("--alloc-check");
+    if (checkArg > 0 && checkArg + 1 < app.arguments().size())
+        allocCheckTicks = app.arguments().at(checkArg + 1).toInt();
+    if (allocCheckTicks > 0) {
+        // Scratch logs, so the CSV/event writes are measured even when
+        // /root is not writable; the emulated clock is scripted
+        co2LogPath   = QDir::tempPath() + "/co2_alloc_check_log.csv";
+        co2EventPath = QDir::tempPath() + "/co2_alloc_check_events.csv";
+        QFile::remove(co2LogPath);
+        QFile::remove(co2EventPath);
+        ccs811_emu_clock = 0;
+    }
+#endif
+
     MainWindow w;
     w.showFullScreen();
     return app.exec();
@@ -3,3 +3,27 @@ CONFIG += c++11
 
 SOURCES += main.cpp \
            ccs811_qt.c
+
+HEADERS += change_detector.h \
+           co2_replay.h
+
+# Desktop builds without the sensor: qmake CONFIG+=ccs811_emulate
+ccs811_emulate {
+    DEFINES += CCS811_EMULATE
+}
+
+# Allocation accounting build: qmake CONFIG+=alloc_count
+#   ./my_qt_app -platform offscreen --alloc-check 400
+# (runs on the emulated sensor, so it works on a desktop)
+alloc_count {
+    DEFINES += CO2_COUNT_ALLOCS CCS811_EMULATE
+}
+
+# Touch-to-wake latency replay: qmake CONFIG+=wake_replay
+#   ./my_qt_app -platform offscreen --wake-replay 50
+# (injects taps through the platform input queue, a private Qt API;
+#  runs on the emulated sensor, so it works on a desktop)
+wake_replay {
+    QT += gui-private
+    DEFINES += CO2_WAKE_REPLAY CCS811_EMULATE
+}
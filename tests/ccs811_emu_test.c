@@ -0,0 +1,152 @@
+// Baseline save/restore against the emulated CCS811 register file.
+// Build and run: make -C tests check
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+int init_ccs811(void);
+int ccs811_save_baseline(void);
+int ccs811_conditioning_remaining(void);
+void ccs811_emu_reset(void);
+
+extern uint8_t ccs811_emu_regs[256][8];
+extern long ccs811_emu_clock;
+extern long ccs811_emu_wall;
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+static void write_baseline_file(unsigned baseline, long saved_at)
+{
+    FILE *f = fopen(CCS811_BASELINE_FILE, "w");
+    fprintf(f, "%04x %ld\n", baseline, saved_at);
+    fclose(f);
+}
+
+static int file_restores(void)
+{
+    unsigned baseline = 0;
+    long saved_at = 0;
+    int restores = -1;
+    FILE *f = fopen(CCS811_BASELINE_FILE, "r");
+    if (!f)
+        return -1;
+    if (fscanf(f, "%x %ld %d", &baseline, &saved_at, &restores) != 3)
+        restores = -1;
+    fclose(f);
+    return restores;
+}
+
+static unsigned restored_baseline(void)
+{
+    return (ccs811_emu_regs[0x11][0] << 8) | ccs811_emu_regs[0x11][1];
+}
+
+// Power-on without touching the file
+static unsigned reboot(void)
+{
+    ccs811_emu_reset();
+    CHECK(init_ccs811() == 0);
+    return restored_baseline();
+}
+
+// Power-on with the given file contents; returns what landed in BASELINE
+static unsigned boot_with(unsigned baseline, long saved_at)
+{
+    write_baseline_file(baseline, saved_at);
+    return reboot();
+}
+
+int main(void)
+{
+    long now = (long)time(NULL);
+    long unset = 10L * 24 * 3600;          // clock not set: early 1970
+    long y2000 = 946684800L;
+    ccs811_emu_clock = 1000;
+
+    // Fresh baseline is written right after APP_START; 20 min run-in only
+    CHECK(boot_with(0x8a3c, now - 3600) == 0x8a3c);
+    CHECK(ccs811_conditioning_remaining() == 20 * 60);
+    CHECK(file_restores() == 1);
+
+    // Slightly ahead (clocks disagree) is fine, far ahead is a bad stamp
+    CHECK(boot_with(0x8a3c, now + 3600) == 0x8a3c);
+    CHECK(boot_with(0x8a3c, now + 30L * 24 * 3600) == 0);
+
+    // Saved before the clock was set, restored after: age unknown, kept
+    CHECK(boot_with(0x8a3c, y2000) == 0x8a3c);
+
+    // Restored before the clock is set: kept, but only for a bounded
+    // number of boots without a fresh save
+    ccs811_emu_wall = unset;
+    CHECK(boot_with(0x8a3c, now - 3600) == 0x8a3c);
+    int boots = 1;
+    while (reboot() == 0x8a3c && boots < 100)
+        boots++;
+    CHECK(boots == 14);
+    ccs811_emu_wall = -1;
+
+    // Stale, blank and out-of-range baselines are rejected; conditioning
+    // then takes a full day
+    CHECK(boot_with(0x8a3c, now - 15L * 24 * 3600) == 0);
+    CHECK(boot_with(0x0000, now) == 0);
+    CHECK(boot_with(0xffff, now) == 0);
+    CHECK(boot_with(0x18a3c, now) == 0);
+    CHECK(ccs811_conditioning_remaining() == 24 * 3600);
+
+    // No file at all
+    unlink(CCS811_BASELINE_FILE);
+    CHECK(reboot() == 0);
+
+    // Nothing is learned yet: saving is refused until the full day is over,
+    // not just the run-in
+    ccs811_emu_regs[0x11][0] = 0x12;
+    ccs811_emu_regs[0x11][1] = 0x34;
+    CHECK(ccs811_save_baseline() == 1);
+    ccs811_emu_clock += 20 * 60;
+    CHECK(ccs811_save_baseline() == 1);
+    CHECK(access(CCS811_BASELINE_FILE, F_OK) != 0);
+    ccs811_emu_clock += 24 * 3600;
+    CHECK(ccs811_conditioning_remaining() == 0);
+    CHECK(ccs811_save_baseline() == 0);
+
+    unsigned saved = 0;
+    long saved_at = 0;
+    FILE *f = fopen(CCS811_BASELINE_FILE, "r");
+    CHECK(f != NULL);
+    if (f) {
+        CHECK(fscanf(f, "%x %ld", &saved, &saved_at) == 2);
+        fclose(f);
+    }
+    CHECK(saved == 0x1234);
+    CHECK(file_restores() == 0);
+    CHECK(access(CCS811_BASELINE_FILE ".tmp", F_OK) != 0);
+
+    // ... and is what the next boot restores; a restored (learned) baseline
+    // may be saved again right after the run-in
+    CHECK(reboot() == 0x1234);
+    CHECK(ccs811_save_baseline() == 1);
+    ccs811_emu_clock += 20 * 60;
+    CHECK(ccs811_save_baseline() == 0);
+    CHECK(file_restores() == 0);
+
+    // A blank register is never persisted
+    ccs811_emu_regs[0x11][0] = 0xff;
+    ccs811_emu_regs[0x11][1] = 0xff;
+    CHECK(ccs811_save_baseline() == -3);
+
+    unlink(CCS811_BASELINE_FILE);
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("ccs811_emu_test: OK\n");
+    return 0;
+}
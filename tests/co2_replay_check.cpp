@@ -0,0 +1,8 @@
+// Change detector replay against an annotated log (no Qt).
+// Build and run: make -C tests check
+#include "co2_replay.h"
+
+int main(int argc, char *argv[])
+{
+    return replayLog(argc > 1 ? argv[1] : "co2_replay_fixture.csv");
+}